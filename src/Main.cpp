@@ -10,8 +10,113 @@
 
 #define COUNT (1024 * 1024)
 
+typedef TAllocator<4, 4 * COUNT> TestAllocator;
+
+static int failures = 0;
+#define CHECK(condition) do { if (!(condition)) { printf("Check failed at line %d: %s\n", __LINE__, #condition); failures++; } } while (0)
+
+static bool IsZeroed(void* ptr, uint64_t bytes) {
+	for (uint64_t i = 0; i < bytes; i++) {
+		if (((uint8_t*) ptr)[i] != 0) return false;
+	}
+	return true;
+}
+
+//Allocates count zeroed blocks of bytes, checks them and then dirties them so the next round has to clear them again
+static void AllocateZeroedRound(TestAllocator& alloc, void** ptrs, int count, uint64_t bytes) {
+	for (int i = 0; i < count; i++) {
+		ptrs[i] = alloc.AllocateZeroed(bytes);
+		CHECK(ptrs[i] != nullptr && IsZeroed(ptrs[i], bytes));
+		if (ptrs[i] != nullptr) memset(ptrs[i], 0xFF, bytes);
+	}
+}
+
+static void CheckAllocateZeroed() {
+	TestAllocator alloc;
+	void* ptrs[4096];
+	for (uint64_t bytes : { 24ull, 100ull, 3000ull, 5ull * COUNT }) {//The last size is above MAX_ALLOC so it comes from the heap
+		int count = (bytes > 4 * COUNT) ? 4 : 4096;
+		AllocateZeroedRound(alloc, ptrs, count, bytes);
+		for (int i = 0; i < count; i++) alloc.Free(ptrs[i], bytes);
+		AllocateZeroedRound(alloc, ptrs, count, bytes);//Reuses the dirty chunks
+		for (int i = 0; i < count; i++) alloc.Free(ptrs[i], bytes);
+		alloc.Trim();
+		AllocateZeroedRound(alloc, ptrs, count, bytes);//Partly recommited pages
+		if (bytes <= 4 * COUNT) {
+			alloc.FreeAll();
+		} else {
+			for (int i = 0; i < count; i++) alloc.Free(ptrs[i], bytes);
+		}
+		AllocateZeroedRound(alloc, ptrs, count, bytes);
+		for (int i = 0; i < count; i++) alloc.Free(ptrs[i], bytes);
+	}
+}
+
+static void CheckReallocate() {
+	TestAllocator alloc;
+	char* ptr = (char*) alloc.Allocate(40);
+	strcpy(ptr, "TMalloc");
+	CHECK(alloc.Reallocate(ptr, 40, 60) == ptr);//Both fit in the 64 byte class
+
+	char* moved = (char*) alloc.Reallocate(ptr, 60, 1000);
+	CHECK(moved != ptr && strcmp(moved, "TMalloc") == 0);
+	moved = (char*) alloc.Reallocate(moved, 0, 3000);//The size class that owns it says how much to copy
+	CHECK(strcmp(moved, "TMalloc") == 0);
+
+	char* large = (char*) alloc.Reallocate(moved, 3000, 5 * COUNT);//Above MAX_ALLOC
+	CHECK(large != nullptr && strcmp(large, "TMalloc") == 0);
+	large[5 * COUNT - 1] = 'x';
+	large = (char*) alloc.Reallocate(large, 5 * COUNT, 6 * COUNT);
+	CHECK(strcmp(large, "TMalloc") == 0 && large[5 * COUNT - 1] == 'x');
+	char* small = (char*) alloc.Reallocate(large, 0, 100);//The heap block's size is looked up
+	CHECK(small != nullptr && strcmp(small, "TMalloc") == 0);
+	alloc.Free(small, 100);
+}
+
+static int pressureCalls = 0;
+static bool OnMemoryPressure(uint64_t committed, uint64_t limit, void* userData) {
+	pressureCalls++;
+	return false;//We have nothing to give back so the allocation should fail
+}
+
+static void CheckSoftLimit() {
+	TestAllocator alloc;
+	uint64_t limit = PlatformUtils::GetProcessVirtualMemoryUsage() + 8 * COUNT;
+	alloc.SetSoftLimit(limit);
+	alloc.SetMemoryPressureCallback(OnMemoryPressure);
+	pressureCalls = 0;
+	int count = 0;
+	while (alloc.Allocate(1024) != nullptr && count < 64 * COUNT) count++;
+	CHECK(count > 0 && count < 64 * COUNT);
+	CHECK(pressureCalls == 1);//Only the allocation that failed should ask for memory
+	CHECK(PlatformUtils::GetProcessVirtualMemoryUsage() <= limit);
+	alloc.FreeAll();
+	CHECK(alloc.Allocate(1024) != nullptr);//Freed chunks can be used again without going over the limit
+}
+
+static void CheckCacheLineExclusive() {
+	TestAllocator alloc;
+	void* first = alloc.AllocateCacheLineExclusive(4);
+	void* second = alloc.AllocateCacheLineExclusive(4);
+	CHECK(((uint64_t) first % TM_CACHE_LINE_SIZE) == 0 && ((uint64_t) second % TM_CACHE_LINE_SIZE) == 0);
+	CHECK(first != second);
+
+	alloc.FreeCacheLineExclusive(first, 4);//Freeing by the requested size has to find the rounded up size class
+	bool reused = false;
+	for (int i = 0; i < 1024 && !reused; i++) {
+		reused = alloc.AllocateCacheLineExclusive(4) == first;
+	}
+	CHECK(reused);
+}
+
 int main() {
 	PlatformUtils::Init();
+	CheckAllocateZeroed();
+	CheckReallocate();
+	CheckSoftLimit();
+	CheckCacheLineExclusive();
+	printf("%d checks failed\n", failures);
+
 	uint64_t pageSize = TUtils::GetPageSize();
 	int j = 1;
 	TAllocator<4, 4 * COUNT> alloc;
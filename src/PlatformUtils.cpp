@@ -88,6 +88,32 @@ unsigned long long PlatformUtils::GetProcessPhysicalMemoryUsage() {
 	SIZE_T physMemUsedByMe = pmc.WorkingSetSize;
 	return physMemUsedByMe;
 }
+
+static bool GetJobLimits(JOBOBJECT_EXTENDED_LIMIT_INFORMATION* info) {
+	//NULL queries the job the calling process is in. Containers run processes inside a job with a memory limit
+	return QueryInformationJobObject(NULL, JobObjectExtendedLimitInformation, info, sizeof(*info), NULL) != 0;
+}
+
+unsigned long long PlatformUtils::GetProcessMemoryLimit() {
+	JOBOBJECT_EXTENDED_LIMIT_INFORMATION info;
+	if (!GetJobLimits(&info) || !(info.BasicLimitInformation.LimitFlags & JOB_OBJECT_LIMIT_PROCESS_MEMORY))
+		return 0;//Not in a job or the job does not limit each process
+	return info.ProcessMemoryLimit;
+}
+
+unsigned long long PlatformUtils::GetJobMemoryLimit() {
+	JOBOBJECT_EXTENDED_LIMIT_INFORMATION info;
+	if (!GetJobLimits(&info) || !(info.BasicLimitInformation.LimitFlags & JOB_OBJECT_LIMIT_JOB_MEMORY))
+		return 0;
+	return info.JobMemoryLimit;
+}
+
+unsigned long long PlatformUtils::GetJobMemoryUsage() {
+	JOBOBJECT_MEMORY_USAGE_INFORMATION info;
+	if (!QueryInformationJobObject(NULL, JobObjectMemoryUsageInformation, &info, sizeof(info), NULL))
+		return GetProcessVirtualMemoryUsage();//Not in a job so we are the only process that counts
+	return info.JobMemory;
+}
 	
 float PlatformUtils::GetSystemCPUUsagePercent() {
 	PDH_FMT_COUNTERVALUE counterVal;
@@ -12,6 +12,9 @@ public:
 	static unsigned long long GetTotalMachinePhysicalMemory();//The amount of physical ram avilable to this machine in bytes
 	static unsigned long long GetSystemPhysicalMemoryUsage();//The amount of physical ram used by this machine in bytes
 	static unsigned long long GetProcessPhysicalMemoryUsage();//The amount of physical ram used by this process in bytes
+	static unsigned long long GetProcessMemoryLimit();//The commit limit imposed on each process by the job object (container) this process is in, in bytes, or 0 if there is none
+	static unsigned long long GetJobMemoryLimit();//The commit limit imposed on all the processes in this process's job object together in bytes, or 0 if there is none
+	static unsigned long long GetJobMemoryUsage();//The memory commited by all the processes in this process's job object in bytes
 
 	static float GetSystemCPUUsagePercent();//from [0,100] indicates the total CPU usage across all cores
 	static float GetProcessCPUUsagePercent();//from [0,100] indicates the total CPU usage across all cores by this process
@@ -8,6 +8,8 @@
 #include <vector>
 
 #include "TUtils.h"
+#include "TAddressSpace.h"
+#include "TTrace.h"
 
 #define TMALLOC_IN_USE 0
 #define TMALLOC_FREE 1
@@ -35,96 +37,89 @@
 class SizedAllocator {
 
 public:
-	SizedAllocator() {}//Default constructor does nothing
+	SizedAllocator() {}//Default constructor does nothing. The allocator reserves no memory until Init is called
+
+	//Reserves address space from TAddressSpace. The reservation starts at TM_INITIAL_RESERVATION bytes and grows in place up to maxCapacity bytes as memory is commited.
+	//Nothing is commited until the first allocation. Returns false and leaves the allocator uninitialized if no address space could be reserved
+	bool Init(uint64_t allocSize, uint64_t maxCapacity) {
+		maxCapacity = TUtils::RoundUp(maxCapacity, TUtils::AllocationGranularity());
+		uint64_t reserved = (maxCapacity < TM_INITIAL_RESERVATION) ? maxCapacity : TM_INITIAL_RESERVATION;
+		bool placed = false;
+		uint8_t* block = (uint8_t*) TAddressSpace::Reserve(reserved, allocSize, maxCapacity, placed);//Reserve the address space
+		if (block == nullptr) return false;//Stay uninitialized so the next allocation tries again
 
-	void Init(uint64_t allocSize, uint64_t startingSize, uint64_t maxCapacity) {
 		this->m_AllocSize = allocSize;
-		this->m_Size = startingSize;
-		this->m_MaxCapacity = maxCapacity;
-		if (FreeListSize() == 0) return;
-		m_Block = (uint8_t*) TUtils::OSAllocVMemory(maxCapacity);//Reserve the address space
-		TUtils::OSAllocRMemory(m_Block, startingSize);//Map the inital capacity
-
-		m_FreeList = (uint64_t*) TUtils::OSAllocHeap(FreeListSize());
-		memset(m_FreeList, 0xFF, FreeListSize());//Set all bits to 1's (indicates that each chunk is open)
-		if (m_Block == nullptr) m_NextAllocLocation = ALLOC_LOCATION_FULL;
-		else m_NextAllocLocation = 0;
+		this->m_Block = block;
+		this->m_MaxCapacity = reserved;
+		this->m_ReservationLimit = maxCapacity;
+		this->m_InitialReservation = reserved;
+		this->m_ReservationPieces = 1;
+		this->m_Placed = placed;
+		m_Size = 0;
+		m_NextAllocLocation = ALLOC_LOCATION_FULL;//Resize() will point this at the first chunk
+		m_HighWaterMark = 0;
+		return true;
+	}
+
+	bool IsInitialized() { return m_AllocSize != 0; }
+
+	//Same as Allocate() but the first bytes of the returned chunk are filled with zeros. The rest of a reused chunk is left as is.
+	//Chunks that have never been handed out since their pages were commited are already zeroed by the OS so they are not cleared again
+	void* AllocateZeroed(uint64_t bytes) {
+		if (!EnsureFreeChunk()) return nullptr;
+		bool fresh = m_NextAllocLocation >= m_HighWaterMark;
+		void* result = Allocate();
+		if (result != nullptr && !fresh) {
+			memset(result, 0, (bytes < AllocSize()) ? bytes : AllocSize());
+		}
+		return result;
 	}
 
-	//Allocates a buffer that starts at the returned pointer and is ALLOC_SIZE bytes long. Returns null if there are no free chunks
+	//Allocates a buffer that starts at the returned pointer and is ALLOC_SIZE bytes long.
+	//If there are no free chunks more memory is commited first. Returns null if that fails
 	void* Allocate() {
-		if (m_NextAllocLocation == ALLOC_LOCATION_FULL) {
+		if (!EnsureFreeChunk()) {
 #ifdef SHOW_ALL_CHANGES
 			PrintPage();
 			printf("No chunks avilable ^\n");
 #endif
 			return nullptr;
-		} else {//We have memory to spare
-			void* result = ChunkIndexToAddress(m_NextAllocLocation);
-			ReserveChunk(m_NextAllocLocation);
-			//Update m_NextAllocLocation to point to a different un-allocated chunk or ALLOC_LOCATION_FULL if no memory is avilable
-			if (IsIndexAvilable(m_NextAllocLocation + 1)) {//The next index is avilable
-				m_NextAllocLocation++;
+		}
+		void* result = ChunkIndexToAddress(m_NextAllocLocation);
+		ReserveChunk(m_NextAllocLocation);
+		if (m_NextAllocLocation >= m_HighWaterMark) m_HighWaterMark = m_NextAllocLocation + 1;
 #ifdef TM_RETURN_MEMORY
-				m_ChunksInUse++;
+		m_ChunksInUse++;
 #endif
+		//Update m_NextAllocLocation to point to a different un-allocated chunk or ALLOC_LOCATION_FULL if there are none left.
+		//We dont commit more memory here. That waits until an allocation actually needs it
+		if (IsIndexAvilable(m_NextAllocLocation + 1)) {//The next index is avilable
+			m_NextAllocLocation++;
 #ifdef SHOW_ALL_CHANGES
-				PrintPage({ m_NextAllocLocation - 1, m_NextAllocLocation }, { FOREGROUND_BLUE, FOREGROUND_GREEN });
-#endif
-			} else {//We must try to find another index somewhere else
-				for (int i = 0; i < FreeListElements(); i++) {
-					uint64_t value = m_FreeList[i];
-					if (value) {//There is a free chunk somewhere in these 64 chunks
-#ifdef SHOW_ALL_CHANGES	
-						uint64_t oldLocation = m_NextAllocLocation;
+			PrintPage({ m_NextAllocLocation - 1, m_NextAllocLocation }, { FOREGROUND_BLUE, FOREGROUND_GREEN });
 #endif
-						m_NextAllocLocation = MakeChunkAddress(i, TUtils::GetMinBitPosition(value));
+		} else {//We must try to find another index somewhere else
 #ifdef SHOW_ALL_CHANGES
-						PrintPage({ oldLocation, m_NextAllocLocation }, { FOREGROUND_BLUE, FOREGROUND_RED });
-#endif
-#ifdef TM_RETURN_MEMORY
-						m_ChunksInUse++;
+			uint64_t oldLocation = m_NextAllocLocation;
 #endif
-						return result;//Return so we dont set the next location to out of memory
-					}
-				}
+			TM_TRACE_BEGIN(scanStart);
+			m_NextAllocLocation = FindFreeChunk();
+			TM_TRACE_END(scanStart, TM_TRACE_BITMAP_SCAN, AllocSize(), AllocSize());
 #ifdef SHOW_ALL_CHANGES
-				PrintPage({ m_NextAllocLocation }, { FOREGROUND_RED });
-#endif
-				m_NextAllocLocation++;//We know the next one is avilable
-				uint64_t newSize = Size() / AllocSize();
-				if (Size() < (512 * 1024)) {
-					newSize = Size() * 4;//Be greedy at the start
-				} else if(Size() < (16 * 1024 * 1024)) {
-					newSize = Size() * 3;
-				} else if (Size() < (128 * 1024 * 1024)) {
-					newSize = Size() * 2;
-				} else if (Size() < (1024 * 1024 * 1024)) {
-					newSize = Size() * 3 / 2;//*1.5
-				} else {
-					newSize = Size() * 9 / 8;//*1.125
-				}
-				Resize(newSize);
-#ifdef TM_RETURN_MEMORY
-				if (m_NextAllocLocation != ALLOC_LOCATION_FULL) 
-					m_ChunksInUse++;
+			PrintPage({ oldLocation, m_NextAllocLocation }, { FOREGROUND_BLUE, FOREGROUND_RED });
 #endif
-				//if this fails m_NextAllocLocation will be set accordingly
-			}
-			return result;
 		}
+		return result;
 	}
 
 	bool Free(void* address) {
-		if (address == nullptr) return false;
-		if ((uint64_t) address < (uint64_t) m_Block) return false;// Bad free, this is not our address
+		if (!Owns(address)) return false;// Bad free, this is not our address
 		uint64_t index = ((uint64_t) address - (uint64_t) m_Block) / AllocSize();
-		if (index >= ChunkCount()) return false;//Not our address
 #ifdef TM_RETURN_MEMORY
 		if(UnReserveChunk(index))
 			m_ChunksInUse--;
 #else
-		UnReserveChunk(index)
+		UnReserveChunk(index);
 #endif
 #ifdef SHOW_ALL_CHANGES
 		PrintPage({ index }, { FOREGROUND_BLUE });
@@ -133,50 +128,82 @@ public:
 		return true;
 	}
 
-	void Resize(uint64_t newSize) {
-		uint64_t oldSize = Size(), oldFreeListSize = FreeListSize();
-		uint64_t* oldFreeList = m_FreeList;
-		if (newSize >= MaxCapacity()) {
-			if (Size() >= MaxCapacity()) {//Last time we went over the max size to allign to a page boundary. So we are entierly out of space
-				m_NextAllocLocation = ALLOC_LOCATION_FULL;
-				return;
-			} else {
-				newSize = MaxCapacity();//Last time we were below the max capacity. This will be the last call to commit more memory to this address space
-			}
-		}
-		uint64_t addedBytes = newSize - oldSize;
-		if (addedBytes < AllocSize()) {
-			addedBytes = AllocSize();
+	//Returns true if address is inside one of this allocator's commited chunks
+	bool Owns(void* address) {
+		if (address == nullptr || m_FreeList == nullptr) return false;
+		if ((uint64_t) address < (uint64_t) m_Block) return false;
+		return ((uint64_t) address - (uint64_t) m_Block) / AllocSize() < ChunkCount();
+	}
+
+	//Returns true if there is a commited chunk ready to be allocated. If not the next allocation has to call Resize()
+	bool HasFreeChunk() { return m_NextAllocLocation != ALLOC_LOCATION_FULL; }
+
+	//The size Resize() should grow to once the allocator runs out of chunks
+	uint64_t NextGrowthSize() {
+		uint64_t newSize;
+		if (Size() < (512 * 1024)) {
+			newSize = Size() * 4;//Be greedy at the start
+		} else if(Size() < (16 * 1024 * 1024)) {
+			newSize = Size() * 3;
+		} else if (Size() < (128 * 1024 * 1024)) {
+			newSize = Size() * 2;
+		} else if (Size() < (1024 * 1024 * 1024)) {
+			newSize = Size() * 3 / 2;//*1.5
+		} else {
+			newSize = Size() * 9 / 8;//*1.125
 		}
-		newSize = addedBytes + oldSize;
-		newSize = TUtils::RoundUp(newSize, TUtils::GetPageSize());//Make sure the new size is a mutiple of the page size
-//#ifdef SHOW_ALL_CHANGES
-		printf("Resizing up %.1lf%% to %s\n", (double) newSize / Size() * 100.0, TUtils::BytesToString(newSize).c_str());
-//#endif
+		uint64_t minSize = MinGrowthSize();
+		return (newSize > minSize) ? TUtils::RoundUp(newSize, TUtils::GetPageSize()) : minSize;
+	}
 
-		m_Size = newSize;//Re-assign Capacity, FreeListSize, and all the other accessors will return the new values
-		void* startingSection = TUtils::OSAllocRMemory((uint8_t*) m_Block + oldSize, addedBytes);
-		if (startingSection == nullptr) {
-			m_NextAllocLocation = ALLOC_LOCATION_FULL;
-			printf("Unable to resize block to %ull bytes. Error: %d", newSize, GetLastError());
-			DebugBreak();
+	//The smallest size that holds one more chunk than we have now
+	uint64_t MinGrowthSize() {
+		return TUtils::RoundUp((ChunkCount() + 1) * AllocSize(), TUtils::GetPageSize());
+	}
+
+	//Commits memory up to newSize bytes so more chunks can be allocated, growing the reservation if it is too small.
+	//Returns false and leaves the allocator unchanged if not even one more chunk could be added
+	bool Resize(uint64_t newSize) {
+		TM_TRACE_BEGIN(resizeStart);
+		uint64_t oldSize = Size(), oldChunkCount = ChunkCount();
+		newSize = TUtils::RoundUp(newSize, TUtils::GetPageSize());//Make sure the new size is a mutiple of the page size
+		if (newSize > MaxCapacity() && !ExtendReservation(newSize)) {
+			newSize = MaxCapacity();//The reservation cannot grow any further so commit what is left of it
+		}
+		if (newSize / AllocSize() <= oldChunkCount) {//We are entierly out of space
+			TM_TRACE_END(resizeStart, TM_TRACE_RESIZE_FAILURE, AllocSize(), 0);
+			return false;
 		}
 
-		m_FreeList = (uint64_t*) TUtils::OSAllocHeap(FreeListSize());
-		if (m_Block == nullptr || m_FreeList == nullptr) {
-			m_NextAllocLocation = ALLOC_LOCATION_FULL;
-			return;
+		TM_TRACE_BEGIN(commitStart);
+		if (!CommitRange(oldSize, newSize)) {
+			DWORD error = GetLastError();//Read before anything else can overwrite it
+			TM_TRACE_END(commitStart, TM_TRACE_COMMIT_FAILURE, AllocSize(), newSize - oldSize);
+			TM_TRACE_END(resizeStart, TM_TRACE_RESIZE_FAILURE, AllocSize(), newSize - oldSize);
+			printf("Unable to resize block to %llu bytes. Error: %lu\n", newSize, error);
+			return false;//The caller decides what to do when we are out of memory
 		}
 
-		memcpy(m_FreeList, oldFreeList, oldFreeListSize);
-		memset((uint8_t*) m_FreeList + oldFreeListSize, 0xFF, FreeListSize() - oldFreeListSize);//Set all new bits to 1's
-		TUtils::OSFreeHeap(oldFreeList);
+		m_Size = newSize;//Re-assign Capacity, FreeListSize, and all the other accessors will return the new values
+		if (FreeListElements() > m_FreeListCapacity && !GrowFreeList()) {
+			DecommitRange(oldSize, newSize);
+			m_Size = oldSize;
+			TM_TRACE_END(resizeStart, TM_TRACE_RESIZE_FAILURE, AllocSize(), newSize - oldSize);
+			return false;
+		}
+		SetChunkRange(oldChunkCount, ChunkCount(), true);
+		if (m_NextAllocLocation == ALLOC_LOCATION_FULL) m_NextAllocLocation = oldChunkCount;
+		TM_TRACE_END(resizeStart, TM_TRACE_RESIZE, AllocSize(), newSize - oldSize);
+#ifdef SHOW_ALL_CHANGES
+		printf("Resized up from %s to %s\n", TUtils::BytesToString(oldSize).c_str(), TUtils::BytesToString(newSize).c_str());
+#endif
+		return true;
 	}
 
 	void PrintPage(std::vector<uint64_t> bitIndices = std::vector<uint64_t>(), std::vector<uint32_t> color = std::vector<uint32_t>()) {
 		uint64_t used = 0;
 		for (int i = 0; i < FreeListElements(); i++) {
-			used += TUtils::CountZeroBits(m_FreeList[i]);
+			used += TUtils::CountZeroBits(m_FreeList[i] | ~ValidBits(i));
 		}
 		if(bitIndices.size() == 0) printf("\nMemory Page Max Capacity: %s, In Use: %s, Chunk Size: %llu bytes, Total Chunks: %llu, Free List Elements: %llu\n", 
 			TUtils::BytesToString(MaxCapacity(), 2).c_str(), TUtils::BytesToString(Size()).c_str(), AllocSize(), ChunkCount(), FreeListElements());
@@ -209,28 +236,64 @@ public:
 	}
 
 	void FreeAll() {
+		if (m_FreeList == nullptr) return;//Never used
+		SetChunkRange(0, ChunkCount(), true);//Every chunk is avilable again
+		m_NextAllocLocation = (ChunkCount() != 0) ? 0 : ALLOC_LOCATION_FULL;
+#ifdef TM_RETURN_MEMORY
+		m_ChunksInUse = 0;
+		m_BytesFreedSinceMemReleaseCheck = 0;//0 since we are releasing the memory
+#endif
 #ifdef TM_MEMORY_ON_FREE_ALL
 		if (TM_SIZE_AFTER_FREE_ALL != 0) {//If we are decommiting memory...
-	#ifdef TM_RETURN_MEMORY
-			m_ChunksInUse = 0;
-			m_BytesFreedSinceMemReleaseCheck = 0;//0 since we are releasing the memory
-	#endif
-			TUtils::OSFreeRMemory(m_Block + TM_SIZE_AFTER_FREE_ALL, Size() - TM_SIZE_AFTER_FREE_ALL);
-			m_Size = TM_SIZE_AFTER_FREE_ALL;
+			Trim(TM_SIZE_AFTER_FREE_ALL);
 		}
-		//printf("List: %p, size: %llu\n", m_FreeList, FreeListSize());
-		memset(m_FreeList, 0xFF, FreeListSize());
 #endif
 	}
 
+	//Decommits the free pages at the end of the block while keeping at least minSize bytes (rounded down to whole chunks) commited.
+	//Returns the number of bytes given back to the OS
+	uint64_t Trim(uint64_t minSize) {
+		if (m_FreeList == nullptr) return 0;//Never used
+		TM_TRACE_BEGIN(trimStart);
+		uint64_t used = 0;//One past the index of the last chunk in use
+		for (uint64_t i = FreeListElements(); i > 0; i--) {
+			uint64_t value = ~m_FreeList[i - 1] & ValidBits(i - 1);//Turn the in use bits on
+			if (value) {
+				used = MakeChunkAddress(i - 1, TUtils::GetMaxBitPosition(value)) + 1;
+				break;
+			}
+		}
+		uint64_t newSize = minSize / AllocSize() * AllocSize();//Keeping part of a chunk is no use to anyone
+		if (newSize < used * AllocSize()) newSize = used * AllocSize();
+		newSize = TUtils::RoundUp(newSize, TUtils::GetPageSize());
+		if (newSize >= Size()) return 0;
+
+		uint64_t released = Size() - newSize;
+		SetChunkRange(newSize / AllocSize(), ChunkCount(), false);//The free list must not offer the chunks we are about to decommit
+		DecommitRange(newSize, Size());
+		m_Size = newSize;
+		if (m_HighWaterMark > ChunkCount()) m_HighWaterMark = ChunkCount();//The decommited pages will come back zeroed
+		if (m_NextAllocLocation == ALLOC_LOCATION_FULL || m_NextAllocLocation >= ChunkCount())
+			m_NextAllocLocation = FindFreeChunk();
+		TM_TRACE_END(trimStart, TM_TRACE_TRIM, AllocSize(), released);
+		return released;
+	}
+
 	void Release() {
 		if (m_Block != nullptr) {
-			TUtils::OSFreeVMemory(m_Block);
+			uint64_t offset = 0, piece = m_InitialReservation;
+			for (uint64_t i = 0; i < m_ReservationPieces; i++) {//Each piece was reserved separately so it must be released separately
+				TAddressSpace::Release(m_Block + offset, piece);
+				offset += piece;
+				piece = ExtensionSize(offset);
+			}
+			if (m_Placed) TAddressSpace::ReleasePlacement(m_Block, m_ReservationLimit);
 			m_Block = nullptr;
 		}
 		if (m_FreeList != nullptr) {
 			TUtils::OSFreeHeap(m_FreeList);
 			m_FreeList = nullptr;
+			m_FreeListCapacity = 0;
 		}
 	}
 
@@ -239,7 +302,8 @@ public:
 	}
 
 	uint64_t ChunkCount() { return m_Size / m_AllocSize; }
-	uint64_t FreeListElements() { return ChunkCount() / CHUNKS_PER_LIST_ELEMENT; }
+	//The free list has a bit for every chunk. The unused bits at the end of the last element are kept at 0 (in use)
+	uint64_t FreeListElements() { return (ChunkCount() + CHUNKS_PER_LIST_ELEMENT - 1) / CHUNKS_PER_LIST_ELEMENT; }
 	uint64_t FreeListSize() { return FreeListElements() * sizeof(uint64_t); }
 	uint64_t MaxCapacity() { return m_MaxCapacity; }
 	uint64_t Size() { return m_Size; }
@@ -270,6 +334,103 @@ private:
 		return m_FreeList[GetFreeListIndex(chunkIndex)] & GetFreeListBit(chunkIndex);
 	}
 
+	//Makes sure m_NextAllocLocation points at a free chunk, commiting more memory if there are none
+	inline bool EnsureFreeChunk() {
+		if (m_NextAllocLocation != ALLOC_LOCATION_FULL) return true;
+		return IsInitialized() && Resize(NextGrowthSize());
+	}
+
+	//The reservation doubles each time it grows. Returns the size of the piece that is added to a reservation of reserved bytes
+	inline uint64_t ExtensionSize(uint64_t reserved) {
+		return (reserved < m_ReservationLimit - reserved) ? reserved : m_ReservationLimit - reserved;
+	}
+
+	//Grows the reservation in place until it holds at least size bytes. Returns false if it could not grow that far
+	bool ExtendReservation(uint64_t size) {
+		while (m_MaxCapacity < size) {
+			uint64_t piece = ExtensionSize(m_MaxCapacity);
+			if (piece == 0 || !TAddressSpace::Extend(m_Block + m_MaxCapacity, piece)) return false;
+			m_MaxCapacity += piece;
+			m_ReservationPieces++;
+		}
+		return true;
+	}
+
+	//Returns the offset where the reservation piece holding offset ends
+	uint64_t PieceEnd(uint64_t offset) {
+		uint64_t end = m_InitialReservation;
+		while (offset >= end) end += ExtensionSize(end);
+		return end;
+	}
+
+	//Commits [begin, end) of the block. Windows cannot commit across reservations so this is done one piece at a time
+	bool CommitRange(uint64_t begin, uint64_t end) {
+		for (uint64_t offset = begin; offset < end;) {
+			uint64_t stop = PieceEnd(offset);
+			if (stop > end) stop = end;
+			if (TUtils::OSAllocRMemory(m_Block + offset, stop - offset) == nullptr) {
+				DecommitRange(begin, offset);
+				return false;
+			}
+			offset = stop;
+		}
+		return true;
+	}
+
+	void DecommitRange(uint64_t begin, uint64_t end) {
+		for (uint64_t offset = begin; offset < end;) {
+			uint64_t stop = PieceEnd(offset);
+			if (stop > end) stop = end;
+			TUtils::OSFreeRMemory(m_Block + offset, stop - offset);
+			offset = stop;
+		}
+	}
+
+	//Returns the index of the first avilable chunk or ALLOC_LOCATION_FULL if there are none
+	uint64_t FindFreeChunk() {
+		for (uint64_t i = 0; i < FreeListElements(); i++) {
+			uint64_t value = m_FreeList[i];
+			if (value) {//There is a free chunk somewhere in these 64 chunks
+				return MakeChunkAddress(i, TUtils::GetMinBitPosition(value));
+			}
+		}
+		return ALLOC_LOCATION_FULL;
+	}
+
+	//Marks the chunks in [begin, end) as avilable or in use
+	void SetChunkRange(uint64_t begin, uint64_t end, bool avilable) {
+		while (begin < end) {
+			uint64_t bit = begin % FREE_LIST_ELEMENT_BITS;
+			uint64_t count = FREE_LIST_ELEMENT_BITS - bit;
+			if (count > end - begin) count = end - begin;
+			uint64_t mask = ((count == FREE_LIST_ELEMENT_BITS) ? UINT64_MAX : ((1ULL << count) - 1)) << bit;
+			if (avilable) m_FreeList[GetFreeListIndex(begin)] |= mask;
+			else m_FreeList[GetFreeListIndex(begin)] &= ~mask;
+			begin += count;
+		}
+	}
+
+	//Returns the bits of a free list element that belong to chunks that exist
+	inline uint64_t ValidBits(uint64_t index) {
+		uint64_t remaining = ChunkCount() - index * CHUNKS_PER_LIST_ELEMENT;
+		return (remaining >= CHUNKS_PER_LIST_ELEMENT) ? UINT64_MAX : ((1ULL << remaining) - 1);
+	}
+
+	//Makes room in the free list for FreeListElements() elements
+	bool GrowFreeList() {
+		uint64_t capacity = m_FreeListCapacity * 2;
+		if (capacity < FreeListElements()) capacity = FreeListElements();
+		uint64_t* freeList = (uint64_t*) TUtils::OSAllocHeap(capacity * sizeof(uint64_t), true);//Zeroed so chunks that dont exist yet read as in use
+		if (freeList == nullptr) return false;
+		if (m_FreeList != nullptr) {
+			memcpy(freeList, m_FreeList, m_FreeListCapacity * sizeof(uint64_t));
+			TUtils::OSFreeHeap(m_FreeList);
+		}
+		m_FreeList = freeList;
+		m_FreeListCapacity = capacity;
+		return true;
+	}
+
 	inline bool IsIndexAllocated(uint64_t chunkIndex) { return !IsIndexAvilable(chunkIndex); }
 
 	inline void ReserveChunk(uint64_t chunkIndex) {
@@ -298,12 +459,18 @@ private:
 	}
 
 private:
-	uint8_t* m_Block;//The pointer to the pages of memory given to us by the OS
-	uint64_t* m_FreeList;//for each bit, a 0 means this block is in use, 1 means avilable for allocation
-	uint64_t m_AllocSize;// The number of bytes in a chunk
-	uint64_t m_MaxCapacity;//The number of bytes of virtual memory m_Block is allocated to hold and the absloule largest size it can be before the OS complains
-	uint64_t m_Size;// The amount of bytes currently commited for this process starting at m_Block
-	uint64_t m_NextAllocLocation;//The index where the next allocation will be stored. Will be ALLOC_LOCATION_FULL if no memory is avilable
+	uint8_t* m_Block = nullptr;//The pointer to the pages of memory given to us by the OS
+	uint64_t* m_FreeList = nullptr;//for each bit, a 0 means this block is in use, 1 means avilable for allocation
+	uint64_t m_AllocSize = 0;// The number of bytes in a chunk. 0 until Init is called
+	uint64_t m_MaxCapacity = 0;//The number of bytes of address space reserved at m_Block so far. Resize() grows this in place up to m_ReservationLimit
+	uint64_t m_ReservationLimit = 0;//The most address space this allocator will ever reserve
+	uint64_t m_InitialReservation = 0;//The size of the first piece of the reservation. Later pieces double the total so their sizes follow from this
+	uint64_t m_ReservationPieces = 0;//The number of separate OS reservations that make up the block
+	bool m_Placed = false;//True if TAddressSpace set aside room for the block to grow to m_ReservationLimit, which Release() has to give back
+	uint64_t m_FreeListCapacity = 0;//The number of elements m_FreeList has room for
+	uint64_t m_Size = 0;// The amount of bytes currently commited for this process starting at m_Block
+	uint64_t m_NextAllocLocation = ALLOC_LOCATION_FULL;//The index where the next allocation will be stored. Will be ALLOC_LOCATION_FULL if no memory is avilable
+	uint64_t m_HighWaterMark = 0;//Chunks at or above this index have not been handed out since their pages were commited so they are still zeroed
 #ifdef TM_RETURN_MEMORY
 	uint64_t m_BytesFreedSinceMemReleaseCheck = 0;//The number of bytes freed since the last check for decommiting memory
 	uint64_t m_ChunksInUse = 0;//A quick counter for the number of chunks currently allocated. This could also be computed by looking at the bits in m_FreeList
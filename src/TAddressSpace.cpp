@@ -0,0 +1,145 @@
+#include "TAddressSpace.h"
+
+#include <atomic>
+
+#include "TUtils.h"
+
+static std::atomic<uint64_t> s_Budget(TM_ADDRESS_SPACE_BUDGET);
+static std::atomic<uint64_t> s_Reserved(0);
+
+struct TPlacementRange {
+	uint64_t start, size;
+};
+
+//The placement range is handed out from s_NextPlacement upwards. Ranges given back below it are kept in s_FreePlacements until they are reused
+static uint64_t s_NextPlacement = TM_PLACEMENT_START;
+static TPlacementRange s_FreePlacements[TM_MAX_FREE_PLACEMENTS];
+static uint64_t s_FreePlacementCount = 0;
+static std::atomic_flag s_PlacementLock = ATOMIC_FLAG_INIT;//Guards the three above. Placements are only taken and given back when a size class is created or destroyed
+
+static void LockPlacements() {
+	while (s_PlacementLock.test_and_set(std::memory_order_acquire));
+}
+
+static void UnlockPlacements() {
+	s_PlacementLock.clear(std::memory_order_release);
+}
+
+static void RemoveFreePlacement(uint64_t index) {
+	s_FreePlacements[index] = s_FreePlacements[--s_FreePlacementCount];
+}
+
+//Returns the start of maxBytes of unused placement range, or 0 once the range is used up
+static uint64_t TakePlacement(uint64_t maxBytes) {
+	uint64_t address = 0;
+	LockPlacements();
+	for (uint64_t i = 0; i < s_FreePlacementCount; i++) {
+		TPlacementRange& range = s_FreePlacements[i];
+		if (range.size < maxBytes) continue;
+		address = range.start;
+		range.start += maxBytes;
+		range.size -= maxBytes;
+		if (range.size == 0) RemoveFreePlacement(i);
+		break;
+	}
+	if (address == 0 && s_NextPlacement + maxBytes <= TM_PLACEMENT_END) {
+		address = s_NextPlacement;
+		s_NextPlacement += maxBytes;
+	}
+	UnlockPlacements();
+	return address;
+}
+
+//Gives back a range from TakePlacement() so later reservations can use it
+static void ReturnPlacement(uint64_t address, uint64_t maxBytes) {
+	LockPlacements();
+	TPlacementRange returned = { address, maxBytes };
+	for (uint64_t i = 0; i < s_FreePlacementCount;) {//Merge with the free ranges on either side
+		TPlacementRange& range = s_FreePlacements[i];
+		if (range.start + range.size == returned.start || returned.start + returned.size == range.start) {
+			if (range.start < returned.start) returned.start = range.start;
+			returned.size += range.size;
+			RemoveFreePlacement(i);
+		} else {
+			i++;
+		}
+	}
+	if (returned.start + returned.size == s_NextPlacement) {
+		s_NextPlacement = returned.start;//The range is at the top so just move the cursor back
+	} else if (s_FreePlacementCount < TM_MAX_FREE_PLACEMENTS) {
+		s_FreePlacements[s_FreePlacementCount++] = returned;
+	}//Else the range is lost. Later reservations may have to let the OS place them
+	UnlockPlacements();
+}
+
+//Claims bytes of the budget. Returns false and claims nothing if that would go over it
+static bool ClaimBudget(uint64_t bytes) {
+	//Claim first so concurrent reservations cannot go over the budget together
+	if (s_Reserved.fetch_add(bytes) + bytes <= s_Budget.load()) return true;
+	s_Reserved.fetch_sub(bytes);
+	return false;
+}
+
+uint64_t TAddressSpace::ReservationSize(uint64_t allocSize, uint64_t maxSize) {
+	if (allocSize > maxSize / TM_MAX_CHUNKS_PER_CLASS) return maxSize;//Also avoids overflowing below
+	return allocSize * TM_MAX_CHUNKS_PER_CLASS;
+}
+
+void* TAddressSpace::Reserve(uint64_t& bytes, uint64_t minBytes, uint64_t maxBytes, bool& placed) {
+	uint64_t granularity = TUtils::AllocationGranularity();//The OS reserves in multiples of this anyway
+	minBytes = TUtils::RoundUp(minBytes, granularity);
+	maxBytes = TUtils::RoundUp(maxBytes, granularity);
+	uint64_t size = TUtils::RoundUp(bytes, granularity);
+	while (size >= minBytes) {
+		if (ClaimBudget(size)) {//Only take a placement once the budget allows the reservation
+			uint64_t placement = TakePlacement(maxBytes);
+			void* result = nullptr;
+			if (placement != 0) {
+				result = TUtils::OSAllocVMemory(size, (void*) placement);
+				if (result == nullptr) ReturnPlacement(placement, maxBytes);
+			}
+			placed = (result != nullptr);
+			if (result == nullptr) result = TUtils::OSAllocVMemory(size);//Let the OS pick. The reservation will probably not be able to grow in place
+			if (result != nullptr) {
+				bytes = size;
+				return result;
+			}
+			s_Reserved.fetch_sub(size);
+		}
+		if (size == minBytes) break;
+		size = TUtils::RoundUp(size / 2, granularity);
+		if (size < minBytes) size = minBytes;
+	}
+	return nullptr;
+}
+
+bool TAddressSpace::Extend(void* end, uint64_t bytes) {
+	if (!ClaimBudget(bytes)) return false;
+	if (TUtils::OSAllocVMemory(bytes, end) == nullptr) {
+		s_Reserved.fetch_sub(bytes);
+		return false;
+	}
+	return true;
+}
+
+void TAddressSpace::Release(void* ptr, uint64_t bytes) {
+	if (ptr == nullptr) return;
+	TUtils::OSFreeVMemory(ptr);
+	s_Reserved.fetch_sub(bytes);
+}
+
+void TAddressSpace::ReleasePlacement(void* ptr, uint64_t maxBytes) {
+	ReturnPlacement((uint64_t) ptr, TUtils::RoundUp(maxBytes, TUtils::AllocationGranularity()));
+}
+
+void TAddressSpace::SetBudget(uint64_t bytes) {
+	s_Budget.store(bytes);
+}
+
+uint64_t TAddressSpace::Budget() {
+	return s_Budget.load();
+}
+
+uint64_t TAddressSpace::ReservedBytes() {
+	return s_Reserved.load();
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+//The number of bytes of address space all the allocators in this process may reserve together. x64 Windows gives user mode 128 TiB
+#define TM_ADDRESS_SPACE_BUDGET (64ull * 1024ull * 1024ull * 1024ull * 1024ull)//64 TiB
+//A size class reserves room for at most this many chunks. Without this each class would reserve the maximum even for tiny chunks
+#define TM_MAX_CHUNKS_PER_CLASS (1ull << 28)
+//A size class starts with a reservation this big and grows it in place as it fills up
+#define TM_INITIAL_RESERVATION (1024ull * 1024ull * 1024ull)//1 GiB
+//Reservations are placed in this range, each followed by enough unused space to grow to its maximum size.
+//Windows hands out addresses from the bottom up so other allocations rarely land here
+#define TM_PLACEMENT_START 0x100000000000ull//16 TiB
+#define TM_PLACEMENT_END 0x7F0000000000ull//127 TiB
+//The number of separate released ranges of the placement range that are remembered for reuse. Adjacent ranges are merged
+#define TM_MAX_FREE_PLACEMENTS 256
+
+//Reserves and releases the address space for every SizedAllocator in the process.
+//Keeps the total under a shared budget so many TAllocators (ie. one per thread or tenant) can exist at once
+class TAddressSpace {
+public:
+	//Returns the most address space a size class with the given chunk size should grow its reservation to, at most maxSize
+	static uint64_t ReservationSize(uint64_t allocSize, uint64_t maxSize);
+
+	//Reserves bytes of address space placed so that it can later be extended in place up to maxBytes.
+	//If the budget cannot fit all of it the request is halved until it fits, down to minBytes.
+	//bytes is set to the size actually reserved and placed to whether it got room to grow. Returns nullptr if not even minBytes could be reserved
+	static void* Reserve(uint64_t& bytes, uint64_t minBytes, uint64_t maxBytes, bool& placed);
+	//Reserves bytes of address space starting exactly at end, the end of an existing reservation.
+	//Returns false if that would go over the budget or the space is already in use. bytes must be a multiple of the allocation granularity
+	static bool Extend(void* end, uint64_t bytes);
+	//Releases a reservation from Reserve() or Extend(). bytes must be the size that was reserved
+	static void Release(void* ptr, uint64_t bytes);
+	//Gives back the room to grow of a placed reservation once all of it has been released. maxBytes must match the call to Reserve()
+	static void ReleasePlacement(void* ptr, uint64_t maxBytes);
+
+	static void SetBudget(uint64_t bytes);
+	static uint64_t Budget();
+	//The number of bytes currently reserved by all allocators
+	static uint64_t ReservedBytes();
+};
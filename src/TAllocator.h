@@ -2,40 +2,100 @@
 #include <stdint.h>
 #include "SizedAllocator.h"
 #include "TUtils.h"
+#include "PlatformUtils.h"
+#include "TAddressSpace.h"
 
 constexpr uint64_t Compile_Log2Floor(uint64_t n) {
 	return ((n < 2) ? 0 : 1 + Compile_Log2Floor(n / 2));
 }
 
+//The most address space a single size class will grow its reservation to. TAddressSpace sizes smaller classes below this
 #define MAX_ALLOCATOR_SIZE (512ull * 1024ull * 1024ull * 1024ull)//512 GB
 //If defined then allocations bigger than MAX_ALLOC will use a HeapAlloc, HeapFree pair
 #define ENABLE_ABOVE_MAX_ALLOCS
 
+//The cache line size of the CPUs we target (every current x86-64 CPU). Allocations from AllocateCacheLineExclusive() never share one of these
+#define TM_CACHE_LINE_SIZE 64
+
+//Once the process's commit charge reaches this percent of the soft limit every size class is trimmed before commiting more
+#define TM_SOFT_LIMIT_TRIM_PERCENT 90
+//The number of bytes each size class keeps commited when it is trimmed
+#define TM_SIZE_AFTER_TRIM (64 * 1024)
+
+//Called when an allocation would take the process over the soft limit even after trimming.
+//committed is the process's commit charge (or the whole job's for a job wide limit) plus the pending allocation.
+//Return true if memory was released and the allocation should be retried, or false to have the allocation fail
+typedef bool (*TMemoryPressureCallback)(uint64_t committed, uint64_t limit, void* userData);
+
 template<uint64_t MIN_ALLOC, uint64_t MAX_ALLOC, 
 	uint64_t MIN_ALLOC_LOG2 = Compile_Log2Floor(MIN_ALLOC), uint64_t MAX_ALLOC_LOG2 = Compile_Log2Floor(MAX_ALLOC),
 	uint64_t ELEMENTS = MAX_ALLOC_LOG2 - MIN_ALLOC_LOG2 + 1>
 class TAllocator {
+	static_assert(MAX_ALLOC >= TM_CACHE_LINE_SIZE, "AllocateCacheLineExclusive() needs a size class of at least TM_CACHE_LINE_SIZE");
 public:
-	TAllocator() {
-		uint64_t allocSize = MIN_ALLOC;
-		printf("Min alloc %llu, Max alloc %llu, Min alloc log2 %llu, max alloc log2 %llu, elements: %llu\n", MIN_ALLOC, MAX_ALLOC, MIN_ALLOC_LOG2, MAX_ALLOC_LOG2, ELEMENTS);
-		printf("log2(1)=%llu, log2(2)=%llu, log2(3)=%llu, log2(4)=%llu, log2(7)=%llu, log2(8)=%llu, log2(15)=%llu\n", Compile_Log2Floor(1), Compile_Log2Floor(2), Compile_Log2Floor(3), Compile_Log2Floor(4), Compile_Log2Floor(7), Compile_Log2Floor(8), Compile_Log2Floor(15));
-		fflush(stdout);
-		for (int i = 0; i < ELEMENTS; i++) {
-			allocators[i].Init(allocSize, allocSize * 64, MAX_ALLOCATOR_SIZE);
-			allocSize *= 2;
+	TAllocator() {}//Size classes are initialized the first time they are allocated from
+
+	void* Allocate(uint64_t bytes) {
+		return Allocate(bytes, false);
+	}
+
+	//Allocates bytes that are filled with zeros. Memory fresh from the OS is already zeroed so it is not cleared again
+	void* AllocateZeroed(uint64_t bytes) {
+		return Allocate(bytes, true);
+	}
+
+	//Allocates bytes that share no cache line with any other allocation so objects used by different threads dont false share.
+	//Size classes of at least TM_CACHE_LINE_SIZE hand out whole, aligned cache lines so small requests are moved up to that class.
+	//Allocations above MAX_ALLOC are the exception. They come from the OS heap which only aligns them to 16 bytes, so their first and last lines may be shared.
+	//Free the result with FreeCacheLineExclusive() and resize it with ReallocateCacheLineExclusive()
+	void* AllocateCacheLineExclusive(uint64_t bytes) {
+		return Allocate(CacheLineExclusiveSize(bytes));
+	}
+
+	//Frees an allocation from AllocateCacheLineExclusive(). bytes is the size that was requested, or 0 if unknown
+	void FreeCacheLineExclusive(void* ptr, uint64_t bytes = 0) {
+		Free(ptr, (bytes == 0) ? 0 : CacheLineExclusiveSize(bytes));
+	}
+
+	//Resizes an allocation from AllocateCacheLineExclusive(). The result is still cache line exclusive. oldBytes may be 0 if unknown
+	void* ReallocateCacheLineExclusive(void* ptr, uint64_t oldBytes, uint64_t newBytes) {
+		if (newBytes == 0) {
+			FreeCacheLineExclusive(ptr, oldBytes);
+			return nullptr;
 		}
+		return Reallocate(ptr, (oldBytes == 0) ? 0 : CacheLineExclusiveSize(oldBytes), CacheLineExclusiveSize(newBytes));
 	}
 
-	void* Allocate(uint64_t bytes) {
-		if (bytes <= MAX_ALLOC) {
-			return allocators[AllocSizeToIndex(bytes)].Allocate();
+	static constexpr uint64_t CacheLineExclusiveSize(uint64_t bytes) {
+		return (bytes < TM_CACHE_LINE_SIZE) ? TM_CACHE_LINE_SIZE : bytes;
+	}
+
+	//Resizes the allocation at ptr from oldSize bytes (the size it was allocated with, or 0 if unknown) to newSize bytes, keeping its contents.
+	//Returns ptr itself if newSize still fits in the same size class. On failure nullptr is returned and ptr is left untouched
+	void* Reallocate(void* ptr, uint64_t oldSize, uint64_t newSize) {
+		if (ptr == nullptr) return Allocate(newSize);
+		if (oldSize == 0) oldSize = AllocationSize(ptr);//Copy everything the allocation could hold since we dont know how much was used
+		if (newSize == 0) {
+			Free(ptr, oldSize);
+			return nullptr;
+		}
+		if (oldSize <= MAX_ALLOC && newSize <= MAX_ALLOC) {
+			if (AllocSizeToIndex(oldSize) == AllocSizeToIndex(newSize)) return ptr;//Same chunk so nothing to do
 		}
 #ifdef ENABLE_ABOVE_MAX_ALLOCS
-		return TUtils::OSAllocHeap(bytes);
-#else
-		return nullptr;
+		else if (oldSize > MAX_ALLOC && newSize > MAX_ALLOC) {
+			if (newSize > oldSize && !CheckSoftLimit(newSize - oldSize)) return nullptr;
+			TM_TRACE_BEGIN(reallocStart);
+			void* result = TUtils::OSReallocHeap(ptr, newSize);//The heap can grow the block in place without us copying it
+			TM_TRACE_END(reallocStart, TM_TRACE_LARGE_REALLOC, 0, newSize);
+			return result;
+		}
 #endif
+		void* result = Allocate(newSize);
+		if (result == nullptr) return nullptr;
+		memcpy(result, ptr, (oldSize < newSize) ? oldSize : newSize);
+		Free(ptr, oldSize);
+		return result;
 	}
 
 	void Free(void* ptr, size_t size = 0) {
@@ -47,12 +107,16 @@ public:
 				}
 			}
 #ifdef ENABLE_ABOVE_MAX_ALLOCS
+			TM_TRACE_BEGIN(freeStart);
 			TUtils::OSFreeHeap(ptr);//This was not allocated by any allocator so it must have been from the heap
+			TM_TRACE_END(freeStart, TM_TRACE_LARGE_FREE, 0, 0);
 #endif
 		} else {
 #ifdef ENABLE_ABOVE_MAX_ALLOCS
 			if (size > MAX_ALLOC) {
+				TM_TRACE_BEGIN(freeStart);
 				TUtils::OSFreeHeap(ptr);
+				TM_TRACE_END(freeStart, TM_TRACE_LARGE_FREE, 0, size);
 			} else {
 				allocators[AllocSizeToIndex(size)].Free(ptr);
 			}
@@ -62,15 +126,64 @@ public:
 		}
 	}
 
+	//Returns the number of usable bytes in the allocation at ptr: the chunk size of the size class that owns it, or the heap block's size
+	uint64_t AllocationSize(void* ptr) {
+		for (int i = 0; i < ELEMENTS; i++) {
+			if (allocators[i].Owns(ptr)) return allocators[i].AllocSize();
+		}
+#ifdef ENABLE_ABOVE_MAX_ALLOCS
+		return TUtils::OSHeapSize(ptr);//Not from any size class so it must be from the heap
+#else
+		return 0;
+#endif
+	}
+
 	void FreeAll() {
 		for (int i = 0; i < ELEMENTS; i++) {//Free everything from each allocator
 			allocators[i].FreeAll();
 		}
+		m_Committed = CountCommitted();
 #ifdef ENABLE_ABOVE_MAX_ALLOCS//Were kinda screwed. How do we track all the allocations to HeapAlloc()?
 
 #endif
 	}
 
+	//Decommits the free memory at the end of every size class. Returns the number of bytes given back to the OS
+	uint64_t Trim() {
+		uint64_t released = 0;
+		for (int i = 0; i < ELEMENTS; i++) {
+			released += allocators[i].Trim(TM_SIZE_AFTER_TRIM);
+		}
+		m_Committed -= released;
+		return released;
+	}
+
+	//Limits the memory commited by the whole process (its commit charge, which is what job objects limit), not just by this allocator.
+	//Every allocator in the process can share the same limit. 0 uses the memory limit of the job object (container) this process runs in, if any.
+	//A per process job limit is compared against this process's commit charge and a job wide one against everything the job's processes commited.
+	//If the job has both the tighter one is used
+	void SetSoftLimit(uint64_t bytes = 0) {
+		m_JobWideLimit = false;
+		m_SoftLimit = bytes;
+		if (bytes != 0) return;
+		uint64_t processLimit = PlatformUtils::GetProcessMemoryLimit(), jobLimit = PlatformUtils::GetJobMemoryLimit();
+		if (jobLimit != 0 && (processLimit == 0 || jobLimit < processLimit)) {
+			m_SoftLimit = jobLimit;
+			m_JobWideLimit = true;
+		} else {
+			m_SoftLimit = processLimit;
+		}
+	}
+
+	void SetMemoryPressureCallback(TMemoryPressureCallback callback, void* userData = nullptr) {
+		m_PressureCallback = callback;
+		m_PressureUserData = userData;
+	}
+
+	uint64_t SoftLimit() { return m_SoftLimit; }
+	//The number of bytes commited by this allocator's size classes. Allocations above MAX_ALLOC are not counted
+	uint64_t CommittedBytes() { return m_Committed; }
+
 	inline uint64_t AllocSizeToIndex(uint64_t bytes) {
 		if (bytes < MIN_ALLOC)
 			return 0;//Round up to the first allocator
@@ -79,5 +192,75 @@ public:
 
 	SizedAllocator allocators[ELEMENTS];
 private:
+	void* Allocate(uint64_t bytes, bool zeroed) {
+		if (bytes <= MAX_ALLOC) {
+			uint64_t index = AllocSizeToIndex(bytes);
+			SizedAllocator& allocator = allocators[index];
+			if (!allocator.HasFreeChunk() && !Grow(index)) return nullptr;
+			return zeroed ? allocator.AllocateZeroed(bytes) : allocator.Allocate();
+		}
+#ifdef ENABLE_ABOVE_MAX_ALLOCS
+		if (!CheckSoftLimit(bytes)) return nullptr;
+		TM_TRACE_BEGIN(allocStart);
+		void* result = TUtils::OSAllocHeap(bytes, zeroed);
+		TM_TRACE_END(allocStart, TM_TRACE_LARGE_ALLOC, 0, bytes);
+		return result;
+#else
+		return nullptr;
+#endif
+	}
+
+	//Commits more memory to a size class that has run out of chunks. The growth is checked against the soft limit before anything is commited.
+	//If the size class's usual growth does not fit we try to commit just enough for one chunk. Only that last attempt may call the pressure callback
+	bool Grow(uint64_t index) {
+		SizedAllocator& allocator = allocators[index];
+		if (!allocator.IsInitialized()) {
+			uint64_t allocSize = MIN_ALLOC << index;
+			if (!allocator.Init(allocSize, TAddressSpace::ReservationSize(allocSize, MAX_ALLOCATOR_SIZE))) return false;
+		}
+		uint64_t newSize = allocator.NextGrowthSize();
+		if (!CheckSoftLimit(newSize - allocator.Size(), false)) {
+			newSize = allocator.MinGrowthSize();
+			if (!CheckSoftLimit(newSize - allocator.Size())) return false;
+		}
+		uint64_t oldSize = allocator.Size();//Read after CheckSoftLimit since it may have trimmed this size class
+		bool grown = allocator.Resize(newSize);
+		m_Committed += allocator.Size() - oldSize;
+		return grown;
+	}
+
+	//Returns true if pending more bytes can be commited without taking the process over the soft limit.
+	//Trims the size classes when we get close. If askCallback is set the pressure callback is asked for memory before giving up
+	bool CheckSoftLimit(uint64_t pending, bool askCallback = true) {
+		if (m_SoftLimit == 0) return true;
+		uint64_t committed = MemoryUsage() + pending;
+		if (committed < m_SoftLimit / 100 * TM_SOFT_LIMIT_TRIM_PERCENT) return true;
+		Trim();
+		committed = MemoryUsage() + pending;
+		if (committed <= m_SoftLimit) return true;
+		if (!askCallback || m_PressureCallback == nullptr || !m_PressureCallback(committed, m_SoftLimit, m_PressureUserData))
+			return false;
+		Trim();//The callback may have freed memory back to us
+		return MemoryUsage() + pending <= m_SoftLimit;
+	}
+
+	//The memory the soft limit applies to
+	uint64_t MemoryUsage() {
+		return m_JobWideLimit ? PlatformUtils::GetJobMemoryUsage() : PlatformUtils::GetProcessVirtualMemoryUsage();
+	}
+
+	uint64_t CountCommitted() {
+		uint64_t total = 0;
+		for (int i = 0; i < ELEMENTS; i++) {
+			total += allocators[i].Size();
+		}
+		return total;
+	}
+
+	uint64_t m_SoftLimit = 0;//The maximum number of bytes we try to stay under. 0 means no limit
+	bool m_JobWideLimit = false;//True if m_SoftLimit limits every process in our job object together rather than just this one
+	uint64_t m_Committed = 0;//The total number of bytes commited by all the size classes
+	TMemoryPressureCallback m_PressureCallback = nullptr;
+	void* m_PressureUserData = nullptr;
 
 };
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "TTrace.h"
+
+#ifdef TM_TRACE
+
+#include <stdio.h>
+#include <atomic>
+#include <new>
+#include <Windows.h>
+
+#include "TUtils.h"
+
+struct TTraceBuffer {
+	TTraceRecord ring[TM_TRACE_RING_SIZE];
+	std::atomic<uint64_t> head;//The number of events ever written. The newest one is at (head - 1) % TM_TRACE_RING_SIZE
+	uint32_t histogram[TM_TRACE_EVENT_COUNT][TM_TRACE_SIZE_CLASSES][TM_TRACE_HISTOGRAM_BUCKETS];
+	uint32_t threadID;
+	TTraceBuffer* next;
+};
+
+//Every thread's buffer. Buffers are never freed so the dump functions can walk this list at any time without locking
+static std::atomic<TTraceBuffer*> s_Buffers(nullptr);
+static thread_local TTraceBuffer* t_Buffer = nullptr;
+
+static TTraceBuffer* CreateBuffer() {
+	void* memory = TUtils::OSAllocHeap(sizeof(TTraceBuffer));
+	if (memory == nullptr) return nullptr;
+	TTraceBuffer* buffer = new (memory) TTraceBuffer();
+	buffer->threadID = GetCurrentThreadId();
+
+	TTraceBuffer* head = s_Buffers.load(std::memory_order_relaxed);
+	do {
+		buffer->next = head;
+	} while (!s_Buffers.compare_exchange_weak(head, buffer, std::memory_order_release, std::memory_order_relaxed));
+	return buffer;
+}
+
+static inline uint64_t BucketIndex(uint64_t value, uint64_t buckets) {
+	if (value == 0) return 0;
+	uint64_t index = TUtils::LogFloor(value);
+	return (index < buckets) ? index : buckets - 1;
+}
+
+void TTrace::Record(TTraceEvent event, uint64_t allocSize, uint64_t bytes, uint64_t start) {
+	uint64_t cycles = Now() - start;
+	TTraceBuffer* buffer = t_Buffer;
+	if (buffer == nullptr) {
+		buffer = t_Buffer = CreateBuffer();
+		if (buffer == nullptr) return;
+	}
+	buffer->histogram[event][BucketIndex(allocSize, TM_TRACE_SIZE_CLASSES)][BucketIndex(cycles, TM_TRACE_HISTOGRAM_BUCKETS)]++;
+
+	//Only this thread writes to its ring so a relaxed load is enough. The release store publishes the record to the dump functions
+	uint64_t head = buffer->head.load(std::memory_order_relaxed);
+	TTraceRecord& record = buffer->ring[head % TM_TRACE_RING_SIZE];
+	record.start = start;
+	record.cycles = cycles;
+	record.bytes = bytes;
+	record.allocSize = allocSize;
+	record.event = event;
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+//Returns the upper bound in cycles of the bucket containing the given percentile
+static uint64_t Percentile(const uint64_t* buckets, uint64_t count, double percentile) {
+	uint64_t target = (uint64_t) (count * percentile), seen = 0;
+	for (uint64_t i = 0; i < TM_TRACE_HISTOGRAM_BUCKETS; i++) {
+		seen += buckets[i];
+		if (seen > target) return 2ULL << i;
+	}
+	return 2ULL << (TM_TRACE_HISTOGRAM_BUCKETS - 1);
+}
+
+void TTrace::DumpHistograms() {
+	//Sum every thread's histograms. The counts may be slightly stale if other threads are still recording
+	uint64_t* totals = (uint64_t*) TUtils::OSAllocHeap(sizeof(uint64_t) * TM_TRACE_EVENT_COUNT * TM_TRACE_SIZE_CLASSES * TM_TRACE_HISTOGRAM_BUCKETS, true);
+	if (totals == nullptr) return;
+	for (TTraceBuffer* buffer = s_Buffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->next) {
+		uint32_t* counts = &buffer->histogram[0][0][0];
+		for (uint64_t i = 0; i < TM_TRACE_EVENT_COUNT * TM_TRACE_SIZE_CLASSES * TM_TRACE_HISTOGRAM_BUCKETS; i++) {
+			totals[i] += counts[i];
+		}
+	}
+
+	printf("\nAllocator slow path latencies (cycles, upper bounds of log2 buckets):\n");
+	for (uint32_t event = 0; event < TM_TRACE_EVENT_COUNT; event++) {
+		for (uint64_t sizeClass = 0; sizeClass < TM_TRACE_SIZE_CLASSES; sizeClass++) {
+			uint64_t* buckets = totals + (event * TM_TRACE_SIZE_CLASSES + sizeClass) * TM_TRACE_HISTOGRAM_BUCKETS;
+			uint64_t count = 0, max = 0;
+			for (uint64_t i = 0; i < TM_TRACE_HISTOGRAM_BUCKETS; i++) {
+				count += buckets[i];
+				if (buckets[i]) max = i;
+			}
+			if (count == 0) continue;
+			printf("%-16s chunk %-10s count: %llu, p50: %llu, p99: %llu, max: %llu\n", EventName((TTraceEvent) event),
+				(sizeClass == 0) ? "-" : TUtils::BytesToString(1ULL << sizeClass, 0).c_str(), count,
+				Percentile(buckets, count, 0.5), Percentile(buckets, count, 0.99), 2ULL << max);
+		}
+	}
+	TUtils::OSFreeHeap(totals);
+}
+
+void TTrace::DumpOutliers(uint64_t minCycles) {
+	printf("\nAllocator slow path events taking at least %llu cycles:\n", minCycles);
+	for (TTraceBuffer* buffer = s_Buffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->next) {
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		uint64_t first = (head > TM_TRACE_RING_SIZE) ? head - TM_TRACE_RING_SIZE : 0;
+		for (uint64_t i = first; i < head; i++) {
+			//The owning thread may overwrite the oldest records while we read them. That is fine for diagnostics
+			TTraceRecord record = buffer->ring[i % TM_TRACE_RING_SIZE];
+			if (record.cycles < minCycles) continue;
+			printf("thread %u at %llu: %-16s chunk %-10s %s took %llu cycles\n", buffer->threadID, record.start, EventName(record.event),
+				(record.allocSize == 0) ? "-" : TUtils::BytesToString(record.allocSize, 0).c_str(),
+				TUtils::BytesToString(record.bytes).c_str(), record.cycles);
+		}
+	}
+}
+
+const char* TTrace::EventName(TTraceEvent event) {
+	switch (event) {
+		case TM_TRACE_BITMAP_SCAN: return "bitmap scan";
+		case TM_TRACE_RESIZE: return "resize";
+		case TM_TRACE_RESIZE_FAILURE: return "resize failure";
+		case TM_TRACE_COMMIT_FAILURE: return "commit failure";
+		case TM_TRACE_TRIM: return "trim";
+		case TM_TRACE_LARGE_ALLOC: return "large alloc";
+		case TM_TRACE_LARGE_REALLOC: return "large realloc";
+		case TM_TRACE_LARGE_FREE: return "large free";
+		default: return "unknown";
+	}
+}
+
+#endif
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+//If this is defined the allocator's slow paths are timed and recorded into per thread buffers that can be dumped with TTrace.
+//When it is not defined the trace macros compile to nothing
+//#define TM_TRACE
+
+//The number of recent events each thread keeps for DumpOutliers()
+#define TM_TRACE_RING_SIZE 1024
+//Histogram bucket i counts the events that took [2^i, 2^(i+1)) cycles. The last bucket also holds everything slower
+#define TM_TRACE_HISTOGRAM_BUCKETS 32
+//Events are grouped by log2 of the chunk size they happened in
+#define TM_TRACE_SIZE_CLASSES 64
+
+enum TTraceEvent : uint32_t {
+	TM_TRACE_BITMAP_SCAN,//SizedAllocator searched its free list for the next free chunk
+	TM_TRACE_RESIZE,//SizedAllocator ran out of chunks and commited more memory
+	TM_TRACE_RESIZE_FAILURE,//SizedAllocator ran out of chunks and could not add any. bytes is 0 if its reservation was full
+	TM_TRACE_COMMIT_FAILURE,//The OS refused to commit more memory
+	TM_TRACE_TRIM,//SizedAllocator decommited the free pages at the end of its block
+	TM_TRACE_LARGE_ALLOC,//An allocation above MAX_ALLOC went to the OS heap
+	TM_TRACE_LARGE_REALLOC,
+	TM_TRACE_LARGE_FREE,
+	TM_TRACE_EVENT_COUNT
+};
+
+#ifdef TM_TRACE
+
+#include <intrin.h>
+
+struct TTraceRecord {
+	uint64_t start;//The timestamp the event began at
+	uint64_t cycles;//How long the event took
+	uint64_t bytes;//The number of bytes involved, ie. the size of the allocation or how much was commited
+	uint64_t allocSize;//The chunk size of the size class, or 0 for allocations above MAX_ALLOC
+	TTraceEvent event;
+};
+
+class TTrace {
+public:
+	static inline uint64_t Now() { return __rdtsc(); }
+
+	//Records an event that began at start (a value from Now()) into the calling thread's buffer
+	static void Record(TTraceEvent event, uint64_t allocSize, uint64_t bytes, uint64_t start);
+
+	//Prints the latency histograms of every event type and size class summed over all threads
+	static void DumpHistograms();
+	//Prints the events each thread recorded recently that took at least minCycles
+	static void DumpOutliers(uint64_t minCycles);
+
+	static const char* EventName(TTraceEvent event);
+};
+
+#define TM_TRACE_BEGIN(name) uint64_t name = TTrace::Now()
+#define TM_TRACE_END(name, event, allocSize, bytes) TTrace::Record(event, allocSize, bytes, name)
+
+#else
+
+#define TM_TRACE_BEGIN(name)
+#define TM_TRACE_END(name, event, allocSize, bytes)
+
+#endif
@@ -18,6 +18,12 @@ uint32_t TUtils::GetMinBitPosition(uint64_t value) {
 	return result;
 }
 
+uint32_t TUtils::GetMaxBitPosition(uint64_t value) {
+	DWORD result;
+	_BitScanReverse64(&result, value);
+	return result;
+}
+
 uint64_t TUtils::CountBits(uint64_t value) {
 	return _mm_popcnt_u64(value);//TODO other implementation for non X86 
 }
@@ -33,8 +39,8 @@ uint64_t TUtils::RoundUp(uint64_t value, uint64_t multiple) {
 	return value + multiple - remainder;
 }
 
-void* TUtils::OSAllocVMemory(uint64_t bytes) {
-	return VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_READWRITE);
+void* TUtils::OSAllocVMemory(uint64_t bytes, void* address) {
+	return VirtualAlloc(address, bytes, MEM_RESERVE, PAGE_READWRITE);
 }
 
 void* TUtils::OSAllocRMemory(void* ptr, uint64_t bytes) {
@@ -49,16 +55,23 @@ void TUtils::OSFreeRMemory(void* ptr, uint64_t bytes) {
 	VirtualFree(ptr, bytes, MEM_DECOMMIT);
 }
 
-void* TUtils::OSAllocHeap(uint64_t bytes) {
+void* TUtils::OSAllocHeap(uint64_t bytes, bool zeroed) {
 	HANDLE heap = GetProcessHeap();
-	printf("allocating %llu heap bytes\n", bytes);
-	return HeapAlloc(heap, 0, bytes);
+	return HeapAlloc(heap, zeroed ? HEAP_ZERO_MEMORY : 0, bytes);
+}
+
+void* TUtils::OSReallocHeap(void* ptr, uint64_t bytes) {
+	return HeapReAlloc(GetProcessHeap(), 0, ptr, bytes);
 }
 
 void TUtils::OSFreeHeap(void* ptr) {
 	HeapFree(GetProcessHeap(), 0, ptr);
 }
 
+uint64_t TUtils::OSHeapSize(void* ptr) {
+	return HeapSize(GetProcessHeap(), 0, ptr);
+}
+
 uint64_t TUtils::GetPageSize() {
 	SYSTEM_INFO info;
 	GetSystemInfo(&info);
@@ -7,14 +7,20 @@ class TUtils {
 public:
 
 	//Calls the relevant OS Heap Allocate function
-	static void* OSAllocVMemory(uint64_t bytes);
+	//If address is not null the memory is reserved there or not at all
+	static void* OSAllocVMemory(uint64_t bytes, void* address = nullptr);
 	static void* OSAllocRMemory(void* ptr, uint64_t bytes);
 
 	static void OSFreeVMemory(void* ptr);
 	static void OSFreeRMemory(void* ptr, uint64_t bytes);
 
-	static void* OSAllocHeap(uint64_t bytes);
+	//If zeroed is true the returned memory is filled with zeros
+	static void* OSAllocHeap(uint64_t bytes, bool zeroed = false);
+	//Resizes a block from OSAllocHeap, growing it in place when the heap can. Returns nullptr and leaves ptr valid on failure
+	static void* OSReallocHeap(void* ptr, uint64_t bytes);
 	static void OSFreeHeap(void* ptr);
+	//Returns the usable size of a block from OSAllocHeap
+	static uint64_t OSHeapSize(void* ptr);
 
 	static uint64_t GetPageSize();
 	static uint64_t AllocationGranularity();
@@ -22,6 +28,8 @@ public:
 
 	//Returns the lowest bit in value 0x1 = 0, 0x100 = 2, etc.
 	static uint32_t GetMinBitPosition(uint64_t value);
+	//Returns the highest bit in value 0x1 = 0, 0x101 = 8, etc.
+	static uint32_t GetMaxBitPosition(uint64_t value);
 	static uint64_t CountBits(uint64_t value);
 	static inline uint64_t CountZeroBits(uint64_t value) { return CountBits(~value); }
 